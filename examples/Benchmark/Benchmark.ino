@@ -0,0 +1,87 @@
+/**
+ * @file Benchmark.ino
+ * Measures every driver operation on the connected RTC.
+ *
+ * Prints one CSV line per operation with the average time per call and the
+ * bus transactions and bytes used per call. Set RTC_CHIP to the chip on the
+ * board: the DS1307 and DS3231 share the same I2C address, so only the chip
+ * that is actually connected can be measured. The RTC date and time are
+ * overwritten.
+ *
+ * To catch regressions without hardware, see the host benchmark in
+ * extras/benchmark, which runs all three drivers on a simulated bus.
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include <Wire.h>
+#include <stdio.h>
+#include "Nanoshield_RTC.h"
+#include "DS1307.h"
+#include "DS3231.h"
+
+#define ITERATIONS 20
+
+// Connected chip: Nanoshield_RTC (PCF8563), DS1307 or DS3231
+#define RTC_CHIP DS3231
+
+#define STRINGIFY(x) #x
+#define NAME(x) STRINGIFY(x)
+
+RTC_CHIP rtc;
+
+char buf[80];
+char timestamp[20];
+
+// Runs an expression ITERATIONS times and prints its cost per call
+#define BENCHMARK(chip, rtc, op, expr) { \
+  bool ok = true; \
+  unsigned long t; \
+  rtc.resetBusStats(); \
+  t = micros(); \
+  for (int i = 0; i < ITERATIONS; i++) { \
+    ok = (expr) && ok; \
+  } \
+  t = micros() - t; \
+  report(chip, op, ok, t, rtc.getBusStats()); \
+}
+
+// Measures all operations of an RTC object
+#define BENCHMARK_ALL(chip, rtc) { \
+  BENCHMARK(chip, rtc, "begin", rtc.begin()); \
+  BENCHMARK(chip, rtc, "stop", rtc.stop()); \
+  BENCHMARK(chip, rtc, "start", rtc.start()); \
+  BENCHMARK(chip, rtc, "write", rtc.write(0, 0, 12, 1, 1, 1, 2018)); \
+  BENCHMARK(chip, rtc, "writeSeconds", rtc.writeSeconds(0)); \
+  BENCHMARK(chip, rtc, "writeMinutes", rtc.writeMinutes(0)); \
+  BENCHMARK(chip, rtc, "writeHours", rtc.writeHours(12)); \
+  BENCHMARK(chip, rtc, "writeDay", rtc.writeDay(1)); \
+  BENCHMARK(chip, rtc, "writeWeekday", rtc.writeWeekday(1)); \
+  BENCHMARK(chip, rtc, "writeMonth", rtc.writeMonth(1)); \
+  BENCHMARK(chip, rtc, "writeYear", rtc.writeYear(2018)); \
+  BENCHMARK(chip, rtc, "read", rtc.read()); \
+  BENCHMARK(chip, rtc, "getTime", (rtc.getTime(timestamp), true)); \
+}
+
+void report(const char* chip, const char* op, bool ok, unsigned long t, const RTCBusStats& stats)
+{
+  // chip,operation,ok,us,transactions,bytes_written,bytes_read (per call)
+  sprintf(buf, "%s,%s,%d,%lu,%lu,%lu,%lu", chip, op, ok, t / ITERATIONS,
+    (unsigned long)stats.transactions / ITERATIONS,
+    (unsigned long)stats.bytesWritten / ITERATIONS,
+    (unsigned long)stats.bytesRead / ITERATIONS);
+  Serial.println(buf);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("chip,operation,ok,us,transactions,bytes_written,bytes_read");
+
+  BENCHMARK_ALL(NAME(RTC_CHIP), rtc);
+}
+
+void loop()
+{
+}
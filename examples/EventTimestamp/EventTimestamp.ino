@@ -0,0 +1,71 @@
+/**
+ * @file EventTimestamp.ino
+ * Timestamps external interrupts using the RTC Nanoshield.
+ *
+ * Events on pin 2 are recorded from the interrupt handler and printed by the
+ * main loop. The queue throughput is measured by the host benchmark in
+ * extras/benchmark.
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include <Wire.h>
+#include <stdio.h>
+#include "Nanoshield_RTC.h"
+#include "RTCEventQueue.h"
+
+#define EVENT_PIN 2
+#define BATCH_SIZE 8
+
+Nanoshield_RTC rtc;
+RTCEventQueue events(rtc);
+RTCTimestamp batch[BATCH_SIZE];
+char buf[40];
+unsigned long lastSync;
+
+void onEvent()
+{
+  events.push(EVENT_PIN);
+}
+
+void setup()
+{
+  Serial.begin(9600);
+  Serial.println("-------------------------");
+  Serial.println(" Nanoshield Event Logger");
+  Serial.println("-------------------------");
+  Serial.println("");
+
+  // Initialize RTC
+  if (!rtc.begin()) {
+    Serial.println("Failed starting RTC");
+    while(true);
+  };
+  while (!events.isSynced()) {
+    events.sync();
+  }
+  lastSync = millis();
+
+  pinMode(EVENT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(EVENT_PIN), onEvent, FALLING);
+}
+
+void loop()
+{
+  uint8_t n = events.drain(batch, BATCH_SIZE);
+
+  // Print events as YYYY-MM-DD HH:MM:SS.UUUUUU
+  for (uint8_t i = 0; i < n; i++) {
+    Nanoshield_RTC::formatUnixTime(buf, batch[i].time);
+    Serial.print(buf);
+    sprintf(buf, ".%06lu event %d", (unsigned long)batch[i].micros, batch[i].id);
+    Serial.println(buf);
+  }
+
+  // Resync with the RTC every minute. sync() polls once per pass and
+  // succeeds on the pass that sees the next RTC second.
+  if (millis() - lastSync >= 60000UL && events.sync()) {
+    lastSync = millis();
+  }
+}
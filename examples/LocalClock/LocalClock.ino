@@ -0,0 +1,68 @@
+/**
+ * @file LocalClock.ino
+ * A serial port clock showing local time in two time zones using the RTC
+ * Nanoshield. The RTC must be set to UTC.
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include <Wire.h>
+#include <stdio.h>
+#include "Nanoshield_RTC.h"
+
+// Central European Time: last Sunday of March at 02:00 to last Sunday of
+// October at 03:00
+constexpr RTCTimeRule cest = {5, 0, 3, 2 * 60, 120};
+constexpr RTCTimeRule cet = {5, 0, 10, 3 * 60, 60};
+constexpr RTCTransition berlinTable[] = {
+  RTC_TIME_ZONE_DECADE(cest, cet, 2020),
+  RTC_TIME_ZONE_DECADE(cest, cet, 2030)
+};
+
+// US Eastern Time: second Sunday of March at 02:00 to first Sunday of
+// November at 02:00
+constexpr RTCTimeRule edt = {2, 0, 3, 2 * 60, -240};
+constexpr RTCTimeRule est = {1, 0, 11, 2 * 60, -300};
+constexpr RTCTransition newYorkTable[] = {
+  RTC_TIME_ZONE_DECADE(edt, est, 2020),
+  RTC_TIME_ZONE_DECADE(edt, est, 2030)
+};
+
+RTCTimeZone berlin(berlinTable, sizeof(berlinTable) / sizeof(RTCTransition), 60);
+RTCTimeZone newYork(newYorkTable, sizeof(newYorkTable) / sizeof(RTCTransition), -300);
+Nanoshield_RTC rtc;
+
+char buf[26];
+
+void setup()
+{
+  Serial.begin(9600);
+  Serial.println("-------------------------");
+  Serial.println(" Nanoshield Local Clock");
+  Serial.println("-------------------------");
+  Serial.println("");
+
+  // Initialize RTC
+  if (!rtc.begin()) {
+    Serial.println("Failed starting RTC");
+    while(true);
+  };
+}
+
+void loop()
+{
+  // Read time from RTC in UTC and in each time zone
+  rtc.readLocal(berlin);
+  rtc.getLocalTime(buf);
+  Serial.print("Berlin:   ");
+  Serial.println(buf);
+
+  rtc.readLocal(newYork);
+  rtc.getLocalTime(buf);
+  Serial.print("New York: ");
+  Serial.println(buf);
+
+  // Wait for next second
+  delay(1000);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file benchmark.cpp
+ * Host benchmark of every driver operation on a simulated I2C bus.
+ *
+ * Runs each operation of the PCF8563 (Nanoshield_RTC), DS1307 and DS3231
+ * drivers against its register model and writes one CSV line per chip and
+ * operation with the wall time, bus transactions and bytes per call. Also
+ * measures a read that recovers a stuck bus, and the push and drain
+ * throughput of RTCEventQueue, per event.
+ *
+ * Usage: benchmark [output.csv] [iterations]
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include <chrono>
+#include "Nanoshield_RTC.h"
+#include "DS1307.h"
+#include "DS3231.h"
+#include "RTCEventQueue.h"
+
+#define QUEUE_BATCH 8
+
+static FILE* out;
+static long iterations = 10000;
+static char timestamp[32];
+static bool failed = false;
+
+// Runs an operation the given number of times and reports its cost per call
+template <class RTC, class Op>
+static void measure(const char* chip, const char* op, RTC& rtc, Op run)
+{
+  bool ok = true;
+
+  rtc.resetBusStats();
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    ok = run() && ok;
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+
+  const RTCBusStats& stats = rtc.getBusStats();
+  fprintf(out, "%s,%s,%d,%.1f,%.2f,%.2f,%.2f\n", chip, op, ok, ns,
+    (double)stats.transactions / iterations,
+    (double)stats.bytesWritten / iterations,
+    (double)stats.bytesRead / iterations);
+  if (!ok) failed = true;
+}
+
+// Runs all operations of a driver with only its register model on the bus
+template <class RTC>
+static void measureAll(const char* chip, RTC& rtc, MockDevice& device)
+{
+  Wire.detachAll();
+  device.reset();
+  Wire.attach(&device);
+
+  measure(chip, "begin", rtc, [&] { return rtc.begin(); });
+  measure(chip, "stop", rtc, [&] { return rtc.stop(); });
+  measure(chip, "start", rtc, [&] { return rtc.start(); });
+  measure(chip, "write", rtc, [&] { return rtc.write(0, 0, 12, 1, 1, 1, 2018); });
+  measure(chip, "writeSeconds", rtc, [&] { return rtc.writeSeconds(0); });
+  measure(chip, "writeMinutes", rtc, [&] { return rtc.writeMinutes(0); });
+  measure(chip, "writeHours", rtc, [&] { return rtc.writeHours(12); });
+  measure(chip, "writeDay", rtc, [&] { return rtc.writeDay(1); });
+  measure(chip, "writeWeekday", rtc, [&] { return rtc.writeWeekday(1); });
+  measure(chip, "writeMonth", rtc, [&] { return rtc.writeMonth(1); });
+  measure(chip, "writeYear", rtc, [&] { return rtc.writeYear(2018); });
+  measure(chip, "read", rtc, [&] { return rtc.read(); });
+  measure(chip, "getTime", rtc, [&] { rtc.getTime(timestamp); return true; });
+
+  // The last write and read must round trip through the register model
+  if (strcmp(timestamp, "2018-01-01 12:00:00") != 0) {
+    fprintf(stderr, "%s: unexpected time %s\n", chip, timestamp);
+    failed = true;
+  }
+}
+
+// Reads with a device holding SDA low, so each read fails once, clocks the
+// bus free and succeeds on the retry
+template <class RTC>
+static void measureRecovery(const char* chip, RTC& rtc)
+{
+  RTCBusPolicy recover = { 0, 25000, 1, 0, true };
+  RTCBusPolicy standard = { 0, 25000, 0, 0, false };
+
+  mockSclPulses = 0;
+  mockStops = 0;
+  rtc.setBusPolicy(recover);
+  measure(chip, "recoverBus", rtc, [&] { mockStuckPulses = 3; return rtc.read(); });
+  rtc.setBusPolicy(standard);
+
+  // Every recovery must clock out the stuck device and send a STOP
+  if (mockSclPulses != 3UL * iterations || mockStops != (unsigned long)iterations) {
+    fprintf(stderr, "%s: %lu SCL pulses and %lu STOPs in bus recovery\n", chip, mockSclPulses, mockStops);
+    failed = true;
+  }
+}
+
+// Fills and drains the event queue in batches, timing each side separately
+static void measureQueue(Nanoshield_RTC& rtc)
+{
+  RTCEventQueue queue(rtc);
+  RTCTimestamp batch[QUEUE_BATCH];
+  std::chrono::steady_clock::duration pushTime(0), drainTime(0);
+  long events = 0;
+  bool ok = true;
+
+  rtc.resetBusStats();
+  for (long i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t j = 0; j < QUEUE_BATCH; j++) {
+      ok = queue.push(j) && ok;
+    }
+    auto mid = std::chrono::steady_clock::now();
+    ok = queue.drain(batch, QUEUE_BATCH) == QUEUE_BATCH && ok;
+    auto end = std::chrono::steady_clock::now();
+
+    pushTime += mid - start;
+    drainTime += end - mid;
+    events += QUEUE_BATCH;
+  }
+
+  // Per event, with no bus usage expected
+  const RTCBusStats& stats = rtc.getBusStats();
+  ok = ok && stats.transactions == 0;
+  fprintf(out, "RTCEventQueue,push,%d,%.1f,0.00,0.00,0.00\n", ok,
+    std::chrono::duration<double, std::nano>(pushTime).count() / events);
+  fprintf(out, "RTCEventQueue,drain,%d,%.1f,0.00,0.00,0.00\n", ok,
+    std::chrono::duration<double, std::nano>(drainTime).count() / events);
+  if (!ok) failed = true;
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = argc > 1 ? argv[1] : "benchmark.csv";
+  Nanoshield_RTC pcf8563;
+  DS1307 ds1307;
+  DS3231 ds3231;
+
+  if (argc > 2) iterations = atol(argv[2]);
+  if (iterations <= 0) iterations = 1;
+
+  out = fopen(path, "w");
+  if (!out) {
+    perror(path);
+    return 1;
+  }
+
+  fprintf(out, "chip,operation,ok,ns,transactions,bytes_written,bytes_read\n");
+  measureAll("PCF8563", pcf8563, mockPCF8563);
+  measureAll("DS1307", ds1307, mockDS1307);
+  measureAll("DS3231", ds3231, mockDS3231);
+  measureRecovery("DS3231", ds3231);
+  measureQueue(ds3231);
+  fclose(out);
+
+  return failed ? 1 : 0;
+}
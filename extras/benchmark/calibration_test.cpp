@@ -0,0 +1,137 @@
+/**
+ * @file calibration_test.cpp
+ * Host test of DS3231Calibrator against a simulated drifting RTC.
+ *
+ * The simulated DS3231 runs at a given drift from a simulated reference
+ * clock, and every read() advances both. Checks the least-squares drift
+ * estimate, the sign and clamp of the aging offset written to the DS3231
+ * register model, step detection and the rate limit of update().
+ *
+ * Usage: calibration_test
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include "DS3231.h"
+#include "DS3231Calibrator.h"
+
+// Simulated time advanced by each RTC read, in seconds
+#define READ_STEP 0.00005
+
+// Seconds between samples
+#define SAMPLE_INTERVAL 900
+
+// Simulated reference time, its value at the start and the RTC time
+// difference, in seconds
+static double now;
+static double origin;
+static double rtcOffset;
+static double rtcDrift;
+static double referenceOffset;
+static long referenceCalls;
+static int failures = 0;
+
+// DS3231 whose time comes from the simulated clock instead of the bus
+class SimDS3231 : public DS3231 {
+  public:
+    bool read()
+    {
+      now += READ_STEP;
+      setUnixTime((uint32_t)(now + (now - origin) * rtcDrift * 1e-6 + rtcOffset));
+      return true;
+    }
+};
+
+static void reference(uint32_t* sec, uint32_t* usec)
+{
+  double t = now + referenceOffset;
+
+  referenceCalls++;
+  *sec = (uint32_t)t;
+  *usec = (uint32_t)((t - *sec) * 1e6);
+}
+
+static void check(const char* name, bool ok)
+{
+  printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+  if (!ok) failures++;
+}
+
+// Restarts the simulation with the given drift (ppm) and a zero aging offset
+static void start(DS3231Calibrator& calibrator, double drift)
+{
+  now = 1514808000;  // 2018-01-01 12:00:00
+  origin = now;
+  rtcOffset = 0;
+  rtcDrift = drift;
+  referenceOffset = 0;
+  referenceCalls = 0;
+  mockDS3231.reset();
+  calibrator.reset();
+}
+
+// Takes samples until the calibrator adjusts the aging offset
+static bool runEstimate(DS3231Calibrator& calibrator)
+{
+  for (int i = 0; i < DS3231_CALIBRATION_SAMPLES; i++) {
+    if (!calibrator.sample()) return false;
+    now += SAMPLE_INTERVAL;
+  }
+  return calibrator.getSamples() == 0;
+}
+
+int main()
+{
+  SimDS3231 rtc;
+  DS3231Calibrator calibrator(rtc, reference);
+  bool ok;
+
+  Wire.attach(&mockDS3231);
+  rtc.begin();
+
+  // 5ppm fast: 50 steps of 0.1ppm, clamped to DS3231_CALIBRATION_MAX_STEP
+  start(calibrator, 5);
+  ok = runEstimate(calibrator);
+  check("fast RTC drift estimate", ok && fabs(calibrator.getDrift() - 5) < 0.1);
+  check("fast RTC aging offset clamped", (int8_t)mockDS3231.regs[0x10] == DS3231_CALIBRATION_MAX_STEP);
+
+  // 1ppm slow: 10 steps down from the current aging offset
+  start(calibrator, -1);
+  mockDS3231.regs[0x10] = 30;
+  ok = runEstimate(calibrator);
+  check("slow RTC drift estimate", ok && fabs(calibrator.getDrift() + 1) < 0.1);
+  check("slow RTC aging offset", (int8_t)mockDS3231.regs[0x10] == 20);
+
+  // Aging offset saturates at the register range
+  start(calibrator, 5);
+  mockDS3231.regs[0x10] = 120;
+  ok = runEstimate(calibrator);
+  check("aging offset saturated", ok && (int8_t)mockDS3231.regs[0x10] == 127);
+
+  // A one second step restarts the estimate
+  start(calibrator, 5);
+  for (int i = 0; i < 3; i++) {
+    calibrator.sample();
+    now += SAMPLE_INTERVAL;
+  }
+  rtcOffset += 1;
+  ok = calibrator.sample();
+  check("time step restarts estimate", ok && calibrator.getSamples() == 1);
+
+  // Drift beyond DS3231_CALIBRATION_MAX_DRIFT, but too small to be taken as a
+  // step, leaves the aging offset unchanged
+  start(calibrator, 12);
+  ok = runEstimate(calibrator);
+  check("implausible drift discarded", ok && mockDS3231.regs[0x10] == 0);
+
+  // A failed sample is not retried before the interval
+  start(calibrator, 0);
+  referenceOffset = 3600;
+  ok = calibrator.update();
+  check("sample fails beyond 30 minutes", !ok && referenceCalls == 1);
+  ok = calibrator.update();
+  check("failed sample not retried", ok && referenceCalls == 1);
+
+  return failures ? 1 : 0;
+}
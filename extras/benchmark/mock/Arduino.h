@@ -0,0 +1,40 @@
+/**
+ * @file Arduino.h
+ * Minimal Arduino core for building the library on the host
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#ifndef ARDUINO_MOCK_h
+#define ARDUINO_MOCK_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LOW  0x0
+#define HIGH 0x1
+
+// I2C pins, as on the Arduino Uno
+#define PIN_WIRE_SDA 18
+#define PIN_WIRE_SCL 19
+
+// Host clock, in the same 32-bit unsigned long range as on the board
+unsigned long micros();
+unsigned long millis();
+
+// Delays do nothing on the host. Only the I2C pins are simulated, see Wire.h.
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * @file Wire.cpp
+ * Simulated I2C bus with register models of the PCF8563, DS1307 and DS3231
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include <time.h>
+#include "Wire.h"
+
+static const uint8_t pcf8563Init[] = {
+  0x00, 0x00,                               // Control and status 1 and 2
+  0x00, 0x00, 0x12, 0x01, 0x01, 0x81, 0x18  // 2018-01-01 12:00:00, century bit set
+};
+
+static const uint8_t ds1307Init[] = {
+  0x00, 0x00, 0x12, 0x02, 0x01, 0x01, 0x18, // 2018-01-01 12:00:00, weekday 2
+  0x10                                      // Control
+};
+
+static const uint8_t ds3231Init[] = {
+  0x00, 0x00, 0x12, 0x02, 0x01, 0x81, 0x18, // 2018-01-01 12:00:00, century bit set
+  0, 0, 0, 0, 0, 0, 0,                      // Alarms
+  0x1C, 0x08,                               // Control and status
+  0x00,                                     // Aging offset
+  0x19, 0x00                                // Temperature
+};
+
+MockDevice mockPCF8563(0x51, 0x10, pcf8563Init, sizeof(pcf8563Init));
+MockDevice mockDS1307(0x68, 0x40, ds1307Init, sizeof(ds1307Init));
+MockDevice mockDS3231(0x68, 0x13, ds3231Init, sizeof(ds3231Init));
+
+TwoWire Wire;
+
+uint8_t mockStuckPulses;
+unsigned long mockSclPulses;
+unsigned long mockStops;
+
+// Output latch, mode and driven level of the SDA and SCL pins
+static uint8_t pinLatch[2] = { HIGH, HIGH };
+static uint8_t pinDirection[2] = { INPUT, INPUT };
+static bool lineLow[2];
+
+static int pinIndex(uint8_t pin)
+{
+  if (pin == PIN_WIRE_SDA) return 0;
+  if (pin == PIN_WIRE_SCL) return 1;
+  return -1;
+}
+
+// Updates a line driven low or released by the pin, tracking the bus events
+static void setLine(int i, bool low)
+{
+  if (i == 1 && lineLow[1] && !low) {
+    mockSclPulses++;
+    if (mockStuckPulses) mockStuckPulses--;
+  }
+  if (i == 0 && lineLow[0] && !low && !lineLow[1] && !mockStuckPulses) {
+    mockStops++;
+  }
+  lineLow[i] = low;
+}
+
+MockDevice::MockDevice(uint8_t addr, uint8_t size, const uint8_t* init, uint8_t initSize)
+  : addr(addr), size(size), init(init), initSize(initSize) {
+  reset();
+}
+
+void MockDevice::reset()
+{
+  memset(regs, 0, sizeof(regs));
+  memcpy(regs, init, initSize);
+  ptr = 0;
+}
+
+void TwoWire::begin()
+{
+  txLen = 0;
+  rxLen = 0;
+  rxPos = 0;
+}
+
+void TwoWire::end()
+{
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+  (void)clock;
+}
+
+void TwoWire::setWireTimeout(uint32_t timeout, bool reset)
+{
+  (void)timeout;
+  (void)reset;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+  txAddr = addr;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+  if (txLen >= WIRE_MOCK_BUFFER_SIZE) return 0;
+  txBuffer[txLen++] = value;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(uint8_t stop)
+{
+  MockDevice* device = find(txAddr);
+  (void)stop;
+
+  if (mockStuckPulses) return 4;  // Bus error
+  if (!device) return 2;  // Address NACK
+  if (txLen == 0) return 0;
+
+  // First byte is the register pointer, the rest are stored from there on
+  device->ptr = txBuffer[0] % device->size;
+  for (uint8_t i = 1; i < txLen; i++) {
+    device->regs[device->ptr] = txBuffer[i];
+    device->ptr = (device->ptr + 1) % device->size;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(int addr, int len)
+{
+  MockDevice* device = find(addr);
+
+  rxLen = 0;
+  rxPos = 0;
+  if (mockStuckPulses || !device || len > WIRE_MOCK_BUFFER_SIZE) return 0;
+
+  while (rxLen < len) {
+    rxBuffer[rxLen++] = device->regs[device->ptr];
+    device->ptr = (device->ptr + 1) % device->size;
+  }
+  return rxLen;
+}
+
+int TwoWire::available()
+{
+  return rxLen - rxPos;
+}
+
+int TwoWire::read()
+{
+  return rxPos < rxLen ? rxBuffer[rxPos++] : -1;
+}
+
+void TwoWire::attach(MockDevice* device)
+{
+  if (count < WIRE_MOCK_MAX_DEVICES) devices[count++] = device;
+}
+
+void TwoWire::detachAll()
+{
+  count = 0;
+}
+
+MockDevice* TwoWire::find(uint8_t addr)
+{
+  for (uint8_t i = 0; i < count; i++) {
+    if (devices[i]->addr == addr) return devices[i];
+  }
+  return NULL;
+}
+
+unsigned long micros()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+unsigned long millis()
+{
+  return micros() / 1000;
+}
+
+void delay(unsigned long ms)
+{
+  (void)ms;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  (void)us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  int i = pinIndex(pin);
+
+  if (i < 0) return;
+  pinDirection[i] = mode;
+  setLine(i, mode == OUTPUT && pinLatch[i] == LOW);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  int i = pinIndex(pin);
+
+  if (i < 0) return;
+  pinLatch[i] = value;
+  if (pinDirection[i] == OUTPUT) setLine(i, value == LOW);
+}
+
+int digitalRead(uint8_t pin)
+{
+  int i = pinIndex(pin);
+
+  if (i < 0) return HIGH;
+  if (lineLow[i] || (i == 0 && mockStuckPulses)) return LOW;
+  return HIGH;
+}
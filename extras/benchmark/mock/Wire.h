@@ -0,0 +1,98 @@
+/**
+ * @file Wire.h
+ * Simulated I2C bus with register models of the PCF8563, DS1307 and DS3231
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#ifndef WIRE_MOCK_h
+#define WIRE_MOCK_h
+
+#include "Arduino.h"
+
+#define WIRE_HAS_TIMEOUT
+
+#define WIRE_MOCK_MAX_DEVICES 4
+#define WIRE_MOCK_BUFFER_SIZE 32
+
+/**
+ * @brief Register file of a simulated I2C device.
+ *
+ * Writes set the register pointer with their first byte and store the
+ * following ones. Reads start at the register pointer. The pointer wraps
+ * around at the end of the register file, as on the real chips.
+ */
+class MockDevice {
+  public:
+    MockDevice(uint8_t addr, uint8_t size, const uint8_t* init, uint8_t initSize);
+
+    void reset();
+
+    uint8_t addr;
+    uint8_t size;
+    uint8_t ptr;
+    uint8_t regs[256];
+
+  protected:
+    const uint8_t* init;
+    uint8_t initSize;
+};
+
+// Register models, set to 2018-01-01 12:00:00 (Monday)
+extern MockDevice mockPCF8563;
+extern MockDevice mockDS1307;
+extern MockDevice mockDS3231;
+
+// SCL pulses a simulated device still needs to release SDA. While it is not
+// zero, SDA reads low and every transaction fails, as on a stuck bus.
+extern uint8_t mockStuckPulses;
+
+// SCL pulses and STOP conditions generated on the I2C pins with pinMode()
+// and digitalWrite(), as done by the bus recovery
+extern unsigned long mockSclPulses;
+extern unsigned long mockStops;
+
+class TwoWire {
+  public:
+    void begin();
+    void end();
+    void setClock(uint32_t clock);
+    void setWireTimeout(uint32_t timeout, bool reset);
+
+    void beginTransmission(uint8_t addr);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(uint8_t stop = 1);
+    uint8_t requestFrom(int addr, int len);
+    int available();
+    int read();
+
+    /**
+     * @brief Connects a simulated device to the bus.
+     *
+     * The DS1307 and DS3231 share address 0x68, so only one of them should be
+     * attached at a time.
+     */
+    void attach(MockDevice* device);
+
+    /**
+     * @brief Disconnects all simulated devices from the bus.
+     */
+    void detachAll();
+
+  protected:
+    MockDevice* find(uint8_t addr);
+
+    MockDevice* devices[WIRE_MOCK_MAX_DEVICES];
+    uint8_t count;
+    uint8_t txAddr;
+    uint8_t txBuffer[WIRE_MOCK_BUFFER_SIZE];
+    uint8_t txLen;
+    uint8_t rxBuffer[WIRE_MOCK_BUFFER_SIZE];
+    uint8_t rxLen;
+    uint8_t rxPos;
+};
+
+extern TwoWire Wire;
+
+#endif
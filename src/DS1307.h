@@ -45,6 +45,11 @@ class DS1307: public DS3231 {
      * @return True on success. False if there were errors.
      */
     bool stop();
+
+  private:
+    // DS3231 only: addresses 0x0E and 0x10 are user RAM on the DS1307
+    using DS3231::readAgingOffset;
+    using DS3231::writeAgingOffset;
 };
 
 #endif
@@ -25,14 +25,15 @@ bool DS3231::begin(uint8_t clkout)
 {
   // Initiate the Wire library and join the I2C bus as a master
   Wire.begin();
+  applyBusPolicy();
 
   // Configure RTC: disable all alarms and enable both the 32.768KHz
   // and 1Hz square wave output
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(0x0E);                                // Start address
-  Wire.write(0b00000100 | ((clkout & 0b11) << 3)); // Control
-  Wire.write(0b00001000);                          // Status
-  return Wire.endTransmission() == 0;
+  uint8_t regs[] = {
+    (uint8_t)(0b00000100 | ((clkout & 0b11) << 3)), // Control
+    0b00001000                                      // Status
+  };
+  return writeRegisters(0x0E, regs, sizeof(regs));
 }
 
 bool DS3231::start()
@@ -53,20 +54,19 @@ bool DS3231::stop()
 
 bool DS3231::write(int sec, int min, int hour, int day, int wday, int mon, int year)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(secondsAddr);            // Start address
-  Wire.write(decToBcd(sec));          // Second (0-59)
-  Wire.write(decToBcd(min));          // Minute (0-59)
-  Wire.write(decToBcd(hour));         // Hour (0-23)
-  Wire.write(decToBcd(wday + 1));     // Weekday (1-7 = Sunday-Saturday)
-  Wire.write(decToBcd(day));          // Day (1-31)
+  uint8_t regs[] = {
+    decToBcd(sec),              // Second (0-59)
+    decToBcd(min),              // Minute (0-59)
+    decToBcd(hour),             // Hour (0-23)
+    decToBcd(wday + 1),         // Weekday (1-7 = Sunday-Saturday)
+    decToBcd(day),              // Day (1-31)
+    decToBcd(mon),              // Month (1-12, century bit set below)
+    decToBcd(year % 100)        // Year (00-99)
+  };
   if (year >= 2000) {
-    Wire.write(decToBcd(mon) | 0x80); // Month (1-12, century bit (bit 7) = 1)
-  } else {
-    Wire.write(decToBcd(mon) & 0x7F); // Month (1-12, century bit (bit 7) = 0)
+    regs[5] |= 0x80;            // Century bit (bit 7) = 1
   }
-  Wire.write(decToBcd(year % 100));   // Year (00-99)
-  return Wire.endTransmission() == 0;
+  return writeRegisters(secondsAddr, regs, sizeof(regs));
 }
 
 bool DS3231::writeWeekday(int wday)
@@ -77,25 +77,36 @@ bool DS3231::writeWeekday(int wday)
 
 bool DS3231::read()
 {
-  int century = 0;
-
-  // Address register containing the seconds
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(secondsAddr);
-  if (Wire.endTransmission()) return false;
+  uint8_t regs[7];
 
   // Read time and date registers
-  if (Wire.requestFrom((int)i2cAddr, 7) != 7) return false;
-  seconds = bcdToDec(Wire.read() & 0x7F);
-  minutes = bcdToDec(Wire.read() & 0x7F);
-  hours   = bcdToDec(Wire.read() & 0x3F);
-  weekday = Wire.read() & 0x07;
-  day     = bcdToDec(Wire.read() & 0x3F);
-  month   = Wire.read();
-  century = month >> 7;
-  month   = bcdToDec(month & 0x1F);
-  year    = bcdToDec(Wire.read()) + 1900;
-  if (century) year += 100;
+  if (!readRegisters(secondsAddr, regs, sizeof(regs))) return false;
+  seconds = bcdToDec(regs[0] & 0x7F);
+  minutes = bcdToDec(regs[1] & 0x7F);
+  hours   = bcdToDec(regs[2] & 0x3F);
+  weekday = regs[3] & 0x07;
+  day     = bcdToDec(regs[4] & 0x3F);
+  month   = bcdToDec(regs[5] & 0x1F);
+  year    = bcdToDec(regs[6]) + 1900;
+  if (regs[5] & 0x80) year += 100;  // Century bit
+  utcOffset = 0;
   
   return true;
 }
+
+bool DS3231::readAgingOffset(int8_t* offset)
+{
+  return readRegister(0x10, (uint8_t*)offset);
+}
+
+bool DS3231::writeAgingOffset(int8_t offset)
+{
+  uint8_t control;
+
+  if (!writeRegister(0x10, offset)) return false;   // Aging offset
+
+  // Read control register
+  if (!readRegister(0x0E, &control)) return false;
+
+  return writeRegister(0x0E, control | 0b00100000); // Set CONV bit to apply the new offset
+}
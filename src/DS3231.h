@@ -70,7 +70,7 @@ class DS3231: public Nanoshield_RTC {
      * @param year Year (4 digits).
      * @return True on success. False if there were errors.
      */
-    bool write(int sec, int min, int hour, int day, int wday, int mon, int year);
+    virtual bool write(int sec, int min, int hour, int day, int wday, int mon, int year);
 
     /**
      * @brief Sets the RTC weekday.
@@ -97,7 +97,33 @@ class DS3231: public Nanoshield_RTC {
      * @see getMonth()
      * @see getYear()
      */
-    bool read();
+    virtual bool read();
+
+    /**
+     * @brief Reads the aging offset register.
+     * 
+     * DS3231 only. Not available on DS1307, where this address is user RAM.
+     * 
+     * @param offset Output pointer to the aging offset, from -128 to 127.
+     * @return True on success. False if there were errors.
+     */
+    bool readAgingOffset(int8_t* offset);
+
+    /**
+     * @brief Sets the aging offset register.
+     * 
+     * Each step changes the oscillator frequency by about 0.1ppm at 25°C.
+     * Positive values slow the clock down and negative values speed it up.
+     * A temperature conversion is started so the new value takes effect
+     * immediately.
+     * 
+     * DS3231 only. Not available on DS1307, where these addresses are user
+     * RAM.
+     * 
+     * @param offset Aging offset from -128 to 127.
+     * @return True on success. False if there were errors.
+     */
+    bool writeAgingOffset(int8_t offset);
 };
 
 #endif
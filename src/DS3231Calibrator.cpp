@@ -0,0 +1,155 @@
+/**
+ * @file DS3231Calibrator.cpp
+ * Aging offset calibration of the DS3231 against a reference clock
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include "DS3231Calibrator.h"
+
+#ifdef ARDUPI
+  #include <sys/time.h>
+
+static void systemClock(uint32_t* sec, uint32_t* usec)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  *sec = tv.tv_sec;
+  *usec = tv.tv_usec;
+}
+#endif
+
+DS3231Calibrator::DS3231Calibrator(DS3231& rtc, RTCReferenceClock reference)
+  : rtc(rtc), reference(reference) {
+  interval = DS3231_CALIBRATION_INTERVAL;
+  lastSample = 0;
+  started = false;
+  drift = 0;
+  count = 0;
+}
+
+#ifdef ARDUPI
+DS3231Calibrator::DS3231Calibrator(DS3231& rtc)
+  : rtc(rtc), reference(systemClock) {
+  interval = DS3231_CALIBRATION_INTERVAL;
+  lastSample = 0;
+  started = false;
+  drift = 0;
+  count = 0;
+}
+#endif
+
+void DS3231Calibrator::setInterval(uint32_t seconds)
+{
+  interval = seconds;
+}
+
+bool DS3231Calibrator::update()
+{
+  // Wait a full interval after every attempt, including failed ones, so a
+  // missing reference or bus errors do not block the main loop on each call
+  if (started && millis() - lastSample < interval * 1000UL) return true;
+  started = true;
+  lastSample = millis();
+  return sample();
+}
+
+bool DS3231Calibrator::sample()
+{
+  uint32_t start = millis();
+  uint32_t sec, usec, rtcTime;
+  int32_t diff, offset;
+  int first;
+
+  // Wait for the RTC seconds to change, so the RTC time is known to be a
+  // whole second
+  if (!rtc.read()) return false;
+  first = rtc.getSeconds();
+  do {
+    if (millis() - start > 1100) return false;
+    if (!rtc.read()) return false;
+  } while (rtc.getSeconds() == first);
+  reference(&sec, &usec);
+  rtcTime = rtc.getUnixTime();
+
+  // Offset must fit in microseconds
+  diff = (int32_t)(rtcTime - sec);
+  if (diff > 1800 || diff < -1800) return false;
+
+  offset = diff * 1000000L - (int32_t)usec;
+
+  // Restart the estimate if the RTC time was stepped since the last sample
+  if (count) {
+    float elapsed = (int32_t)(rtcTime - sampleTime[count - 1]);
+    float change = (float)offset - sampleOffset[count - 1];
+    if (fabs(change) > fabs(elapsed) * DS3231_CALIBRATION_MAX_DRIFT + DS3231_CALIBRATION_STEP_LIMIT) {
+      count = 0;
+    }
+  }
+
+  sampleTime[count] = rtcTime;
+  sampleOffset[count] = offset;
+  if (++count == DS3231_CALIBRATION_SAMPLES) return adjust();
+
+  return true;
+}
+
+void DS3231Calibrator::reset()
+{
+  count = 0;
+}
+
+uint8_t DS3231Calibrator::getSamples()
+{
+  return count;
+}
+
+float DS3231Calibrator::getDrift()
+{
+  return drift;
+}
+
+bool DS3231Calibrator::adjust()
+{
+  float x, y, meanX = 0, meanY = 0, sxx = 0, sxy = 0, step;
+  int8_t aging;
+  int16_t value;
+  uint8_t i;
+
+  // Start a new estimate, since the frequency is about to change
+  count = 0;
+
+  // Least-squares fit of the offset (us) against time (s), relative to the
+  // first sample to keep float precision
+  for (i = 0; i < DS3231_CALIBRATION_SAMPLES; i++) {
+    meanX += (int32_t)(sampleTime[i] - sampleTime[0]);
+    meanY += sampleOffset[i] - sampleOffset[0];
+  }
+  meanX /= DS3231_CALIBRATION_SAMPLES;
+  meanY /= DS3231_CALIBRATION_SAMPLES;
+  for (i = 0; i < DS3231_CALIBRATION_SAMPLES; i++) {
+    x = (int32_t)(sampleTime[i] - sampleTime[0]) - meanX;
+    y = sampleOffset[i] - sampleOffset[0] - meanY;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  if (sxx == 0) return false;
+
+  // Discard implausible estimates, such as from a time step missed above
+  if (fabs(sxy / sxx) > DS3231_CALIBRATION_MAX_DRIFT) return true;
+  drift = sxy / sxx;
+
+  // Each aging offset step is about 0.1ppm, positive values slow the clock.
+  // Limit the change per estimate, so a bad estimate does little harm.
+  step = drift * 10;
+  if (step > DS3231_CALIBRATION_MAX_STEP) step = DS3231_CALIBRATION_MAX_STEP;
+  if (step < -DS3231_CALIBRATION_MAX_STEP) step = -DS3231_CALIBRATION_MAX_STEP;
+  if (!rtc.readAgingOffset(&aging)) return false;
+  value = aging + (int16_t)(step + (step < 0 ? -0.5 : 0.5));
+  if (value > 127) value = 127;
+  if (value < -128) value = -128;
+
+  return rtc.writeAgingOffset(value);
+}
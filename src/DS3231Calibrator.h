@@ -0,0 +1,146 @@
+/**
+ * @file DS3231Calibrator.h
+ * Aging offset calibration of the DS3231 against a reference clock
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#ifndef DS3231_CALIBRATOR_h
+#define DS3231_CALIBRATOR_h
+
+#include "DS3231.h"
+#include "DS1307.h"
+
+// Number of samples in each drift estimate
+#define DS3231_CALIBRATION_SAMPLES 16
+
+// Default time between samples, in seconds (16 samples span about 4 hours)
+#define DS3231_CALIBRATION_INTERVAL 900
+
+// Largest plausible drift in ppm; estimates beyond it are discarded
+#define DS3231_CALIBRATION_MAX_DRIFT 10
+
+// Largest change of the aging offset per estimate (about 0.1ppm per step)
+#define DS3231_CALIBRATION_MAX_STEP 20
+
+// Offset change between samples, beyond the largest plausible drift, that is
+// taken as a time step (resync or write), in microseconds
+#define DS3231_CALIBRATION_STEP_LIMIT 5000
+
+/**
+ * @brief Reference clock used for calibration.
+ *
+ * Must return the reference time when called, for example from the system
+ * clock, a GPS receiver or a simulated clock.
+ *
+ * @param sec Output pointer to seconds since 1970-01-01 00:00:00.
+ * @param usec Output pointer to microseconds within the second.
+ */
+typedef void (*RTCReferenceClock)(uint32_t* sec, uint32_t* usec);
+
+class DS3231Calibrator {
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * Creates a calibrator for the DS3231 using the given reference clock.
+     *
+     * @param rtc The RTC object, already initialized with begin().
+     * @param reference The reference clock.
+     */
+    DS3231Calibrator(DS3231& rtc, RTCReferenceClock reference);
+
+#ifdef ARDUPI
+    /**
+     * @brief Constructor.
+     *
+     * Creates a calibrator for the DS3231 using the system clock as reference.
+     *
+     * @param rtc The RTC object, already initialized with begin().
+     */
+    DS3231Calibrator(DS3231& rtc);
+#endif
+
+    // The DS1307 has no aging offset register
+    DS3231Calibrator(DS1307& rtc, RTCReferenceClock reference) = delete;
+    DS3231Calibrator(DS1307& rtc) = delete;
+
+    /**
+     * @brief Sets the time between samples.
+     *
+     * The aging offset is adjusted every DS3231_CALIBRATION_SAMPLES samples.
+     * Longer intervals give better estimates, since the RTC time can only be
+     * compared to the reference with about one millisecond resolution.
+     *
+     * @param seconds Time between samples, in seconds.
+     */
+    void setInterval(uint32_t seconds);
+
+    /**
+     * @brief Runs the calibration loop.
+     *
+     * Call it often from the main loop. Takes a sample every interval,
+     * blocking for up to one second to find the RTC second boundary. A failed
+     * sample is also only retried after a full interval. Once enough samples
+     * are taken, estimates the drift with a least-squares fit, adjusts the
+     * aging offset and starts over.
+     *
+     * Setting the RTC time (write(), setPrecise(), a resync) invalidates the
+     * samples taken so far. Steps larger than DS3231_CALIBRATION_STEP_LIMIT
+     * are detected and restart the estimate, but call reset() after setting
+     * the time so smaller steps are not mistaken for drift. Estimates beyond
+     * DS3231_CALIBRATION_MAX_DRIFT are discarded, and each adjustment changes
+     * the aging offset by at most DS3231_CALIBRATION_MAX_STEP.
+     *
+     * @return True on success. False if there were errors.
+     */
+    bool update();
+
+    /**
+     * @brief Takes a sample of the RTC against the reference now.
+     *
+     * Blocks for up to one second to find the RTC second boundary. The RTC
+     * must be within 30 minutes of the reference.
+     *
+     * @return True on success. False if there were errors.
+     */
+    bool sample();
+
+    /**
+     * @brief Discards the samples taken for the current estimate.
+     *
+     * Call it after setting the RTC time.
+     */
+    void reset();
+
+    /**
+     * @brief Gets the number of samples taken for the current estimate.
+     *
+     * @return Number of samples.
+     */
+    uint8_t getSamples();
+
+    /**
+     * @brief Gets the last drift estimate.
+     *
+     * @return Drift in ppm. Positive if the RTC runs fast.
+     */
+    float getDrift();
+
+  protected:
+    bool adjust();
+
+    DS3231& rtc;
+    RTCReferenceClock reference;
+    uint32_t interval;
+    uint32_t lastSample;
+    bool started;
+    float drift;
+
+    uint8_t count;
+    uint32_t sampleTime[DS3231_CALIBRATION_SAMPLES];
+    int32_t sampleOffset[DS3231_CALIBRATION_SAMPLES];
+};
+
+#endif
@@ -8,7 +8,26 @@
 
 #include "Nanoshield_RTC.h"
 
+#ifdef ARDUPI
+  #include <sys/time.h>
+#endif
+
+// Gregorian date of a number of days since 1970-01-01
+static void civilFromDays(uint32_t days, int* year, int* mon, int* day)
+{
+  uint32_t z = days + 719468UL;
+  uint32_t era = z / 146097UL;
+  uint32_t doe = z - era * 146097UL;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  *day = doy - (153 * mp + 2) / 5 + 1;
+  *mon = mp < 10 ? mp + 3 : mp - 9;
+  *year = yoe + era * 400 + (*mon <= 2);
+}
+
 Nanoshield_RTC::Nanoshield_RTC() {
+	utcOffset = 0;
 	i2cAddr = 0x51;
 	secondsAddr = 0x02;
 	minutesAddr = 0x03;
@@ -17,190 +36,243 @@ Nanoshield_RTC::Nanoshield_RTC() {
 	weekdayAddr = 0x06;
 	monthAddr = 0x07;
 	yearAddr = 0x08;
+	busPolicy.clock = 0;
+	busPolicy.timeout = 25000;
+	busPolicy.retries = 0;
+	busPolicy.backoff = 0;
+	busPolicy.recovery = false;
+	resetBusStats();
 }
 
 bool Nanoshield_RTC::begin(uint8_t clkout)
 {
 	// Initiate the Wire library and join the I2C bus as a master
   Wire.begin();
+  applyBusPolicy();
 
   // Configure RTC: disable all alarms/timers and enable 1.024kHz output clock
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(0x00);            // Start address
-  Wire.write(0);               // Control and status 1
-  Wire.write(0);               // Control and status 2
-  if (Wire.endTransmission()) return false;
-
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(0x09);                         // Start address
-  Wire.write(0b10000000);                   // Minute alarm (and alarm disabled)
-  Wire.write(0b10000000);                   // Hour alarm (and alarm disabled)
-  Wire.write(0b10000000);                   // Day alarm (and alarm disabled)
-  Wire.write(0b10000000);                   // Weekday alarm (and alarm disabled)
-  Wire.write(0b10000000 | (clkout & 0b11)); // Output clock frequency     
-  Wire.write(0);                            // Timer (countdown) disabled
-  Wire.write(0);                            // Timer value
-  return Wire.endTransmission() == 0;
+  uint8_t control[] = {
+    0,                          // Control and status 1
+    0                           // Control and status 2
+  };
+  if (!writeRegisters(0x00, control, sizeof(control))) return false;
+
+  uint8_t config[] = {
+    0b10000000,                 // Minute alarm (and alarm disabled)
+    0b10000000,                 // Hour alarm (and alarm disabled)
+    0b10000000,                 // Day alarm (and alarm disabled)
+    0b10000000,                 // Weekday alarm (and alarm disabled)
+    (uint8_t)(0b10000000 | (clkout & 0b11)), // Output clock frequency
+    0,                          // Timer (countdown) disabled
+    0                           // Timer value
+  };
+  return writeRegisters(0x09, config, sizeof(config));
+}
+
+void Nanoshield_RTC::setBusPolicy(const RTCBusPolicy& policy)
+{
+  busPolicy = policy;
+  applyBusPolicy();
+}
+
+const RTCBusStats& Nanoshield_RTC::getBusStats()
+{
+  return busStats;
+}
+
+void Nanoshield_RTC::resetBusStats()
+{
+  busStats.transactions = 0;
+  busStats.bytesWritten = 0;
+  busStats.bytesRead = 0;
+  busStats.retries = 0;
 }
 
 bool Nanoshield_RTC::start()
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(0x00);            // Start address
-  Wire.write(0);               // Control and status 1: start RTC
-  return Wire.endTransmission() == 0;
+  return writeRegister(0x00, 0);            // Control and status 1: start RTC
 }
 
 bool Nanoshield_RTC::stop()
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(0x00);            // Start address
-  Wire.write(0x00100000);      // Control and status 1: stop RTC
-  return Wire.endTransmission() == 0;
+  return writeRegister(0x00, 0b00100000);   // Control and status 1: stop RTC
 }
 
 bool Nanoshield_RTC::write(int sec, int min, int hour, int day, int wday, int mon, int year)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(secondsAddr);            // Start address
-  Wire.write(decToBcd(sec));          // Second (0-59)
-  Wire.write(decToBcd(min));          // Minute (0-59)
-  Wire.write(decToBcd(hour));         // Hour (0-23)
-  Wire.write(decToBcd(day));          // Day (1-31)
-  Wire.write(decToBcd(wday));         // Weekday (0-6 = Sunday-Saturday)
+  uint8_t regs[] = {
+    decToBcd(sec),              // Second (0-59)
+    decToBcd(min),              // Minute (0-59)
+    decToBcd(hour),             // Hour (0-23)
+    decToBcd(day),              // Day (1-31)
+    decToBcd(wday),             // Weekday (0-6 = Sunday-Saturday)
+    decToBcd(mon),              // Month (1-12, century bit set below)
+    decToBcd(year % 100)        // Year (00-99)
+  };
 	if (year >= 2000) {
-		Wire.write(decToBcd(mon) | 0x80); // Month (1-12, century bit (bit 7) = 1)
-	} else {
-		Wire.write(decToBcd(mon) & 0x7F); // Month (1-12, century bit (bit 7) = 0)
+		regs[5] |= 0x80;            // Century bit (bit 7) = 1
 	}
-  Wire.write(decToBcd(year % 100));   // Year (00-99)
-  return Wire.endTransmission() == 0;
+  return writeRegisters(secondsAddr, regs, sizeof(regs));
+}
+
+bool Nanoshield_RTC::setPrecise(uint32_t unixTime, uint32_t usec)
+{
+  uint32_t start = micros();
+  uint32_t latency, deadline, days, secs;
+  uint8_t sec, retries;
+  bool ok;
+  int y, m, d;
+
+  // A retried transaction would arrive late, so make a single attempt of
+  // each and let the caller try again
+  retries = busPolicy.retries;
+  busPolicy.retries = 0;
+
+  // Measure the bus latency with a seconds register read. It takes four
+  // bytes (address, register, address, data), and a write reaches the
+  // seconds register after three (address, register, seconds).
+  latency = micros();
+  ok = readRegister(secondsAddr, &sec);
+  latency = (micros() - latency) * 3 / 4;
+
+  if (!ok) {
+    busPolicy.retries = retries;
+    return false;
+  }
+
+  // Pick the next whole second that can still be reached, with 1ms margin
+  // for the date conversion below
+  secs = (usec + (micros() - start) + latency + 1000) / 1000000UL + 1;
+  unixTime += secs;
+  deadline = secs * 1000000UL - usec - latency;
+
+  days = unixTime / 86400UL;
+  secs = unixTime % 86400UL;
+  civilFromDays(days, &y, &m, &d);
+
+  // Wait for the second boundary, minus the time to reach the chip
+  while (micros() - start < deadline);
+
+  ok = write(secs % 60, secs / 60 % 60, secs / 3600, d, (days + 4) % 7, m, y);
+  busPolicy.retries = retries;
+  return ok;
+}
+
+#ifdef ARDUPI
+bool Nanoshield_RTC::setPrecise()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return setPrecise(tv.tv_sec, tv.tv_usec);
 }
+#endif
 
 bool Nanoshield_RTC::writeSeconds(int sec)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(secondsAddr);     // Start address
-  Wire.write(decToBcd(sec));   // Second (0-59)
-  return Wire.endTransmission() == 0;
+  return writeRegister(secondsAddr, decToBcd(sec));   // Second (0-59)
 }
 
 bool Nanoshield_RTC::writeMinutes(int min)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(minutesAddr);     // Start address
-  Wire.write(decToBcd(min));   // Minute (0-59)
-  return Wire.endTransmission() == 0;
+  return writeRegister(minutesAddr, decToBcd(min));   // Minute (0-59)
 }
 
 bool Nanoshield_RTC::writeHours(int hour)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(hoursAddr);       // Start address
-  Wire.write(decToBcd(hour));  // Hour (0-23)
-  return Wire.endTransmission() == 0;
+  return writeRegister(hoursAddr, decToBcd(hour));    // Hour (0-23)
 }
 
 bool Nanoshield_RTC::writeDay(int day)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(dayAddr);         // Start address
-  Wire.write(decToBcd(day));   // Day (1-31)
-  return Wire.endTransmission() == 0;
+  return writeRegister(dayAddr, decToBcd(day));       // Day (1-31)
 }
 
 bool Nanoshield_RTC::writeWeekday(int wday)
 {
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(weekdayAddr);     // Start address
-  Wire.write(decToBcd(wday));  // Weekday (0-6 = Sunday-Saturday)
-  return Wire.endTransmission() == 0;
+  return writeRegister(weekdayAddr, decToBcd(wday));  // Weekday (0-6 = Sunday-Saturday)
 }
 
 bool Nanoshield_RTC::writeMonth(int mon)
 {
-	int century;
+	uint8_t month;
 
-  // Address register containing the months and century
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(monthAddr);
-  if (Wire.endTransmission()) return false;
+	// Read month register, containing the century
+  if (!readRegister(monthAddr, &month)) return false;
 
-	// Read month register
-  if (Wire.requestFrom((int)i2cAddr, 1) != 1) return false;
-  century = Wire.read() & 0x80;
-
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(monthAddr);              // Start address
-	if (century) {
-		Wire.write(decToBcd(mon) | 0x80); // Month (1-12, century bit (bit 7) = 1)
+	if (month & 0x80) {
+		return writeRegister(monthAddr, decToBcd(mon) | 0x80); // Month (1-12, century bit (bit 7) = 1)
 	} else {
-		Wire.write(decToBcd(mon) & 0x7F); // Month (1-12, century bit (bit 7) = 0)
+		return writeRegister(monthAddr, decToBcd(mon) & 0x7F); // Month (1-12, century bit (bit 7) = 0)
 	}
-  return Wire.endTransmission() == 0;
 }
 
 bool Nanoshield_RTC::writeYear(int year)
 {
-	int mon;
-
-  // Address register containing the months and century
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(monthAddr);
-  if (Wire.endTransmission()) return false;
+	uint8_t mon;
 
-	// Read month register
-  if (Wire.requestFrom((int)i2cAddr, 1) != 1) return false;
-  mon = bcdToDec(Wire.read() & 0x1F);
+	// Read month register, containing the century
+  if (!readRegister(monthAddr, &mon)) return false;
+  mon = bcdToDec(mon & 0x1F);
 
 	// Rewrite month along with century bit
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(monthAddr);              // Start address
 	if (year / 100 == 19) {             // Set century bit to zero if 20th century
-		Wire.write(decToBcd(mon) & 0x7F); // Month (1-12, century bit (bit 7) = 0)
+		mon = decToBcd(mon) & 0x7F;       // Month (1-12, century bit (bit 7) = 0)
 	} else {
-		Wire.write(decToBcd(mon) | 0x80); // Month (1-12, century bit (bit 7) = 1)
+		mon = decToBcd(mon) | 0x80;       // Month (1-12, century bit (bit 7) = 1)
 	}
-  if (Wire.endTransmission() != 0) return false;
+  if (!writeRegister(monthAddr, mon)) return false;
 
 	// Write year
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(yearAddr);              // Start address
-  Wire.write(decToBcd(year % 100));  // Year (00-99)
-  return Wire.endTransmission() == 0;
+  return writeRegister(yearAddr, decToBcd(year % 100));  // Year (00-99)
 }
 
 bool Nanoshield_RTC::read()
 {
-	int century = 0;
-
-  // Address register containing the seconds
-  Wire.beginTransmission(i2cAddr);
-  Wire.write(secondsAddr);
-  if (Wire.endTransmission()) return false;
+	uint8_t regs[7];
 
 	// Read time and date registers
-  if (Wire.requestFrom((int)i2cAddr, 7) != 7) return false;
-  seconds = bcdToDec(Wire.read() & 0x7F);
-  minutes = bcdToDec(Wire.read() & 0x7F);
-  hours   = bcdToDec(Wire.read() & 0x3F);
-  day     = bcdToDec(Wire.read() & 0x3F);
-  weekday = Wire.read() & 0x07;
-  month   = Wire.read();
-	century = month >> 7;
-	month   = bcdToDec(month & 0x1F);
-  year    = bcdToDec(Wire.read()) + 1900;
-	if (century) year += 100;
+  if (!readRegisters(secondsAddr, regs, sizeof(regs))) return false;
+  seconds = bcdToDec(regs[0] & 0x7F);
+  minutes = bcdToDec(regs[1] & 0x7F);
+  hours   = bcdToDec(regs[2] & 0x3F);
+  day     = bcdToDec(regs[3] & 0x3F);
+  weekday = regs[4] & 0x07;
+	month   = bcdToDec(regs[5] & 0x1F);
+  year    = bcdToDec(regs[6]) + 1900;
+	if (regs[5] & 0x80) year += 100;  // Century bit
+	utcOffset = 0;
 	
 	return true;
 }
 
+bool Nanoshield_RTC::readLocal(const RTCTimeZone& tz)
+{
+  uint32_t utc;
+
+  if (!read()) return false;
+  utc = getUnixTime();
+  utcOffset = tz.getOffset(utc);
+  setUnixTime(utc + utcOffset * 60L);
+
+  return true;
+}
+
 void Nanoshield_RTC::getTime(char* time)
 {
 	// Format time to YYYY-MM-DD HH:MM:SS
 	sprintf(time, "%04d-%02d-%02d %02d:%02d:%02d", year, month, day, hours, minutes, seconds);
 }
 
+void Nanoshield_RTC::getLocalTime(char* time)
+{
+  int offset = utcOffset < 0 ? -utcOffset : utcOffset;
+
+	// Format time to YYYY-MM-DD HH:MM:SS+HH:MM
+  getTime(time);
+  sprintf(time + 19, "%c%02d:%02d", utcOffset < 0 ? '-' : '+', offset / 60, offset % 60);
+}
+
 int Nanoshield_RTC::getSeconds()
 {
 	return seconds;
@@ -236,6 +308,143 @@ int Nanoshield_RTC::getYear()
 	return year;
 }
 
+int Nanoshield_RTC::getUtcOffset()
+{
+	return utcOffset;
+}
+
+uint32_t Nanoshield_RTC::getUnixTime()
+{
+  return rtcDaysFromCivil(year, month, day) * 86400UL + hours * 3600UL + minutes * 60UL + seconds;
+}
+
+void Nanoshield_RTC::formatUnixTime(char* time, uint32_t unixTime)
+{
+  int y, m, d;
+  uint32_t secs = unixTime % 86400UL;
+
+  civilFromDays(unixTime / 86400UL, &y, &m, &d);
+  sprintf(time, "%04d-%02d-%02d %02d:%02d:%02d", y, m, d,
+    (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60));
+}
+
+void Nanoshield_RTC::setUnixTime(uint32_t unixTime)
+{
+  uint32_t days = unixTime / 86400UL;
+  uint32_t secs = unixTime % 86400UL;
+
+  civilFromDays(days, &year, &month, &day);
+  weekday = (days + 4) % 7;  // 1970-01-01 was a Thursday
+  hours   = secs / 3600;
+  minutes = secs / 60 % 60;
+  seconds = secs % 60;
+}
+
+bool Nanoshield_RTC::writeRegisters(uint8_t addr, const uint8_t* data, uint8_t len)
+{
+  for (uint8_t attempt = 0; ; attempt++) {
+    Wire.beginTransmission(i2cAddr);
+    Wire.write(addr);                   // Start address
+    for (uint8_t i = 0; i < len; i++) {
+      Wire.write(data[i]);
+    }
+    busStats.transactions++;
+    busStats.bytesWritten += len + 1;
+    if (Wire.endTransmission() == 0) return true;
+    if (!retry(attempt)) return false;
+  }
+}
+
+bool Nanoshield_RTC::readRegisters(uint8_t addr, uint8_t* data, uint8_t len)
+{
+  for (uint8_t attempt = 0; ; attempt++) {
+    // Address first register, then read them all
+    Wire.beginTransmission(i2cAddr);
+    Wire.write(addr);
+    busStats.transactions++;
+    busStats.bytesWritten++;
+    if (Wire.endTransmission() == 0) {
+      busStats.transactions++;
+      if (Wire.requestFrom((int)i2cAddr, (int)len) == len) {
+        for (uint8_t i = 0; i < len; i++) {
+          data[i] = Wire.read();
+        }
+        busStats.bytesRead += len;
+        return true;
+      }
+    }
+    if (!retry(attempt)) return false;
+  }
+}
+
+bool Nanoshield_RTC::writeRegister(uint8_t addr, uint8_t value)
+{
+  return writeRegisters(addr, &value, 1);
+}
+
+bool Nanoshield_RTC::readRegister(uint8_t addr, uint8_t* value)
+{
+  return readRegisters(addr, value, 1);
+}
+
+bool Nanoshield_RTC::retry(uint8_t attempt)
+{
+  uint32_t wait;
+
+  if (attempt >= busPolicy.retries) return false;
+  busStats.retries++;
+  if (busPolicy.recovery) recoverBus();
+
+  // Exponential backoff
+  wait = (uint32_t)busPolicy.backoff << (attempt < 16 ? attempt : 16);
+  if (wait > 16000) {
+    delay(wait / 1000);
+  } else if (wait) {
+    delayMicroseconds(wait);
+  }
+
+  return true;
+}
+
+void Nanoshield_RTC::applyBusPolicy()
+{
+#ifndef ARDUPI
+  if (busPolicy.clock) Wire.setClock(busPolicy.clock);
+#endif
+#ifdef WIRE_HAS_TIMEOUT
+  Wire.setWireTimeout(busPolicy.timeout, true);
+#endif
+}
+
+void Nanoshield_RTC::recoverBus()
+{
+// The AVR and SAMD cores name the Wire pins PIN_WIRE_SDA and PIN_WIRE_SCL.
+// Other cores are left to their own Wire timeout handling.
+#if defined(PIN_WIRE_SDA) && defined(PIN_WIRE_SCL) && !defined(ARDUPI)
+  // Clock SCL until the device stuck in a transfer releases SDA
+  Wire.end();
+  pinMode(PIN_WIRE_SDA, INPUT_PULLUP);
+  pinMode(PIN_WIRE_SCL, INPUT_PULLUP);
+  for (uint8_t i = 0; i < 9 && digitalRead(PIN_WIRE_SDA) == LOW; i++) {
+    digitalWrite(PIN_WIRE_SCL, LOW);
+    pinMode(PIN_WIRE_SCL, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(PIN_WIRE_SCL, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+
+  // Generate a STOP condition: SDA rises while SCL is high
+  digitalWrite(PIN_WIRE_SDA, LOW);
+  pinMode(PIN_WIRE_SDA, OUTPUT);
+  delayMicroseconds(5);
+  pinMode(PIN_WIRE_SDA, INPUT_PULLUP);
+  delayMicroseconds(5);
+
+  Wire.begin();
+  applyBusPolicy();
+#endif
+}
+
 uint8_t Nanoshield_RTC::bcdToDec(uint8_t value)
 {
   return ((value / 16) * 10 + value % 16);
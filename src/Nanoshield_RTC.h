@@ -15,12 +15,37 @@
   #include "Arduino.h"
   #include <Wire.h>
 #endif
+#include "RTCTimeZone.h"
 
 #define NANOSHIELD_RTC_CLKOUT_32768_HZ 0
 #define NANOSHIELD_RTC_CLKOUT_1024_HZ  1
 #define NANOSHIELD_RTC_CLKOUT_32_HZ    2
 #define NANOSHIELD_RTC_CLKOUT_1_HZ     3
 
+#define NANOSHIELD_RTC_BUS_STANDARD 100000
+#define NANOSHIELD_RTC_BUS_FAST     400000
+
+/**
+ * @brief Settings applied to every transaction with the RTC.
+ */
+typedef struct {
+  uint32_t clock;   ///< I2C clock in Hz, such as NANOSHIELD_RTC_BUS_FAST, or 0 to keep the Wire default. The DS1307 supports NANOSHIELD_RTC_BUS_STANDARD only.
+  uint32_t timeout; ///< Transaction timeout in microseconds, or 0 to wait forever. Needs a Wire library with setWireTimeout().
+  uint8_t retries;  ///< Number of retries after a failed transaction.
+  uint16_t backoff; ///< Delay before the first retry in microseconds, doubled on each further retry.
+  bool recovery;    ///< Clock the bus free before each retry, in case a device is holding SDA low.
+} RTCBusPolicy;
+
+/**
+ * @brief Bus usage counters, including failed attempts.
+ */
+typedef struct {
+  uint32_t transactions; ///< Number of bus transactions.
+  uint32_t bytesWritten; ///< Number of bytes written, including register addresses.
+  uint32_t bytesRead;    ///< Number of bytes read.
+  uint32_t retries;      ///< Number of retries after failed transactions.
+} RTCBusStats;
+
 class Nanoshield_RTC {
   public:
     /**
@@ -44,6 +69,34 @@ class Nanoshield_RTC {
      */
     bool begin(uint8_t clkout = NANOSHIELD_RTC_CLKOUT_1_HZ);
 
+    /**
+     * @brief Sets the bus settings used by all transactions.
+     * 
+     * Can be called before or after begin(). The default is the Wire clock,
+     * a 25ms timeout and no retries.
+     * 
+     * The clock and timeout are applied with Wire.setClock() and
+     * Wire.setWireTimeout(), which change the Wire settings for every device
+     * on the bus. begin() applies them too, so it sets the 25ms timeout, with
+     * the Wire hardware reset on timeouts, unless another policy was set.
+     * 
+     * @param policy The bus settings.
+     */
+    void setBusPolicy(const RTCBusPolicy& policy);
+
+    /**
+     * @brief Gets the bus usage counters.
+     * 
+     * @return Bus usage since the object was created or since the last call
+     *         to resetBusStats().
+     */
+    const RTCBusStats& getBusStats();
+
+    /**
+     * @brief Clears the bus usage counters.
+     */
+    void resetBusStats();
+
     /**
      * @brief Starts the RTC.
      * 
@@ -70,7 +123,37 @@ class Nanoshield_RTC {
      * @param year Year (4 digits).
      * @return True on success. False if there were errors.
      */
-    bool write(int sec, int min, int hour, int day, int wday, int mon, int year);
+    virtual bool write(int sec, int min, int hour, int day, int wday, int mon, int year);
+
+    /**
+     * @brief Sets the RTC date and time on a second boundary.
+     * 
+     * Writing the seconds register restarts the RTC divider chain, so the
+     * write is delayed until the next whole second of the reference time,
+     * taking into account the latency of the bus. This keeps the RTC in phase
+     * with the reference, instead of up to one second behind it.
+     * 
+     * The reference time must be sampled right before calling this function.
+     * It blocks for up to one second plus the bus latency. Transactions are
+     * not retried, since a retry would land late: on failure, sample the
+     * reference again and call it again.
+     * 
+     * @param unixTime Reference time in seconds since 1970-01-01 00:00:00.
+     * @param usec Microseconds within the second of the reference time.
+     * @return True on success. False if there were errors.
+     */
+    bool setPrecise(uint32_t unixTime, uint32_t usec);
+
+#ifdef ARDUPI
+    /**
+     * @brief Sets the RTC to the system clock (UTC) on a second boundary.
+     * 
+     * @return True on success. False if there were errors.
+     * 
+     * @see setPrecise(uint32_t, uint32_t)
+     */
+    bool setPrecise();
+#endif
 
     /**
      * @brief Sets the RTC seconds.
@@ -145,7 +228,23 @@ class Nanoshield_RTC {
      * @see getMonth()
      * @see getYear()
      */
-    bool read();
+    virtual bool read();
+
+    /**
+     * @brief Read datetime from RTC and stores it internally as local time.
+     * 
+     * The RTC must be set to UTC. The datetime is converted to local time
+     * and can be accessed with the same getters as read(), or with
+     * getLocalTime(), that also includes the UTC offset. The weekday is
+     * always from 0 to 6 as Sunday to Saturday respectively.
+     *
+     * @param tz The time zone.
+     * @return True on success. False if there were errors.
+     * 
+     * @see getLocalTime()
+     * @see getUtcOffset()
+     */
+    bool readLocal(const RTCTimeZone& tz);
 
     /**
      * @brief Get a timestamp of the last reading.
@@ -156,6 +255,17 @@ class Nanoshield_RTC {
      */
     void getTime(char* time);
 
+    /**
+     * @brief Get a timestamp of the last reading, including the UTC offset.
+     * 
+     * The timestamp is in format YYYY-MM-DD HH:MM:SS+HH:MM.
+     * 
+     * @param time Output pointer to timestamp.
+     * 
+     * @see readLocal()
+     */
+    void getLocalTime(char* time);
+
     /**
      * @brief Gets the seconds of the last reading.
      * 
@@ -205,9 +315,45 @@ class Nanoshield_RTC {
      */
     int getYear();
 
+    /**
+     * @brief Gets the UTC offset of the last reading.
+     * 
+     * @return UTC offset in minutes. Zero if the last reading used read().
+     */
+    int getUtcOffset();
+
+    /**
+     * @brief Gets the last reading as Unix time.
+     * 
+     * Only dates from 1970 onwards can be represented.
+     * 
+     * @return Seconds since 1970-01-01 00:00:00 of the last reading.
+     */
+    uint32_t getUnixTime();
+
+    /**
+     * @brief Formats a Unix time as a timestamp.
+     * 
+     * The timestamp is in the same format as getTime(): YYYY-MM-DD HH:MM:SS.
+     * 
+     * @param time Output pointer to timestamp.
+     * @param unixTime Seconds since 1970-01-01 00:00:00.
+     * 
+     * @see getTime()
+     */
+    static void formatUnixTime(char* time, uint32_t unixTime);
+
   protected:
     uint8_t bcdToDec(uint8_t value);
     uint8_t decToBcd(uint8_t value);
+    void setUnixTime(uint32_t unixTime);
+    bool writeRegisters(uint8_t addr, const uint8_t* data, uint8_t len);
+    bool readRegisters(uint8_t addr, uint8_t* data, uint8_t len);
+    bool writeRegister(uint8_t addr, uint8_t value);
+    bool readRegister(uint8_t addr, uint8_t* value);
+    bool retry(uint8_t attempt);
+    void applyBusPolicy();
+    void recoverBus();
     
     int seconds;
     int minutes;
@@ -216,7 +362,10 @@ class Nanoshield_RTC {
     int weekday;
     int month;
     int year;
+    int utcOffset;
     
+    RTCBusPolicy busPolicy;
+    RTCBusStats busStats;
     uint8_t i2cAddr;
     
     uint8_t secondsAddr;
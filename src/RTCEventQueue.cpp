@@ -0,0 +1,104 @@
+/**
+ * @file RTCEventQueue.cpp
+ * Interrupt-safe event timestamping using the RTC Nanoshield
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include "RTCEventQueue.h"
+
+#define RTC_EVENT_QUEUE_MASK (RTC_EVENT_QUEUE_SIZE - 1)
+
+RTCEventQueue::RTCEventQueue(Nanoshield_RTC& rtc) : rtc(rtc) {
+  baseTime = 0;
+  baseMicros = 0;
+  lastPoll = 0;
+  lastSecond = -1;
+  synced = false;
+  head = 0;
+  tail = 0;
+  dropped = 0;
+}
+
+bool RTCEventQueue::sync()
+{
+  uint32_t t = micros();
+  int8_t prev = lastSecond;
+
+  if (!rtc.read()) {
+    lastSecond = -1;
+    return false;
+  }
+  lastSecond = rtc.getSeconds();
+
+  // Latch only if the second started between two close polls
+  if (prev < 0 || lastSecond == prev || t - lastPoll > RTC_EVENT_SYNC_WINDOW) {
+    lastPoll = t;
+    return false;
+  }
+
+  baseMicros = lastPoll + (t - lastPoll) / 2;
+  baseTime = rtc.getUnixTime();
+  synced = true;
+  lastSecond = -1;
+  return true;
+}
+
+bool RTCEventQueue::isSynced()
+{
+  return synced;
+}
+
+bool RTCEventQueue::push(uint8_t id)
+{
+  uint32_t now = micros();
+  uint8_t h = head;
+
+  if ((uint8_t)(h - tail) == RTC_EVENT_QUEUE_SIZE) {
+    if (dropped != 255) dropped = dropped + 1;
+    return false;
+  }
+
+  // Fill the slot before publishing it to the consumer
+  ids[h & RTC_EVENT_QUEUE_MASK] = id;
+  stamps[h & RTC_EVENT_QUEUE_MASK] = now;
+  head = h + 1;
+  return true;
+}
+
+uint8_t RTCEventQueue::drain(RTCTimestamp* events, uint8_t max)
+{
+  uint8_t t = tail;
+  uint8_t h = head;
+  uint8_t n;
+
+  for (n = 0; n < max && t != h; n++, t++) {
+    // Signed offset, so events captured before the last sync() still work
+    int32_t elapsed = (int32_t)(stamps[t & RTC_EVENT_QUEUE_MASK] - baseMicros);
+    int32_t secs = elapsed / 1000000L;
+    int32_t usecs = elapsed % 1000000L;
+    if (usecs < 0) {
+      usecs += 1000000L;
+      secs--;
+    }
+
+    events[n].id = ids[t & RTC_EVENT_QUEUE_MASK];
+    events[n].time = baseTime + secs;
+    events[n].micros = usecs;
+  }
+
+  // Release the slots to the producer
+  tail = t;
+  return n;
+}
+
+uint8_t RTCEventQueue::available()
+{
+  return head - tail;
+}
+
+uint8_t RTCEventQueue::getDropped()
+{
+  return dropped;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file RTCEventQueue.h
+ * Interrupt-safe event timestamping using the RTC Nanoshield
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#ifndef RTC_EVENT_QUEUE_h
+#define RTC_EVENT_QUEUE_h
+
+#include "Nanoshield_RTC.h"
+
+// Number of events the queue can hold (power of two, up to 128). Events
+// beyond this number between two drain() calls are dropped.
+#define RTC_EVENT_QUEUE_SIZE 32
+
+// Largest interval between sync() calls that can latch the time base, in
+// microseconds
+#define RTC_EVENT_SYNC_WINDOW 5000
+
+#if RTC_EVENT_QUEUE_SIZE & (RTC_EVENT_QUEUE_SIZE - 1) || RTC_EVENT_QUEUE_SIZE > 128
+  #error "RTC_EVENT_QUEUE_SIZE must be a power of two up to 128"
+#endif
+
+/**
+ * @brief A timestamped event, as returned by RTCEventQueue::drain().
+ */
+typedef struct {
+  uint8_t id;      ///< Event identifier given to RTCEventQueue::push().
+  uint32_t time;   ///< Seconds since 1970-01-01 00:00:00.
+  uint32_t micros; ///< Microseconds within the second, from 0 to 999999.
+} RTCTimestamp;
+
+class RTCEventQueue {
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * Creates an event queue timestamped by the given RTC.
+     *
+     * @param rtc The RTC object, already initialized with begin().
+     */
+    RTCEventQueue(Nanoshield_RTC& rtc);
+
+    /**
+     * @brief Aligns the queue time base to the RTC second boundary.
+     *
+     * Polls the RTC once per call, without blocking. When the seconds change
+     * between two calls less than RTC_EVENT_SYNC_WINDOW microseconds apart,
+     * the new second is associated with the micros() value at that moment,
+     * so the sub-second part of the timestamps is accurate to half that
+     * window. Call it on every pass of the main loop until it returns true;
+     * passes slower than the window never latch.
+     *
+     * Must be called before the first event and then often enough to keep
+     * the micros() offset of pending events within +/-35 minutes. Each sync
+     * corrects the drift between micros() and the RTC, so timestamps may
+     * step by that drift across syncs.
+     *
+     * @return True when the time base was updated by this call. False while
+     *         waiting for the second boundary, or if there were errors.
+     */
+    bool sync();
+
+    /**
+     * @brief Checks whether the time base was ever set by sync().
+     *
+     * @return True if timestamps are valid.
+     */
+    bool isSynced();
+
+    /**
+     * @brief Records an event with the current time.
+     *
+     * Safe to call from an interrupt handler while the main loop is draining
+     * the queue. Only stores the event id and micros(), so there is no bus
+     * access.
+     *
+     * @param id Event identifier.
+     * @return True on success. False if the queue is full.
+     */
+    bool push(uint8_t id);
+
+    /**
+     * @brief Removes events from the queue and converts them to timestamps.
+     *
+     * Must be called from the main loop only.
+     *
+     * @param events Output array of timestamped events.
+     * @param max Maximum number of events to remove.
+     * @return Number of events written to the output array.
+     */
+    uint8_t drain(RTCTimestamp* events, uint8_t max);
+
+    /**
+     * @brief Gets the number of events waiting in the queue.
+     *
+     * @return Number of events waiting to be drained.
+     */
+    uint8_t available();
+
+    /**
+     * @brief Gets the number of events lost because the queue was full.
+     *
+     * @return Number of lost events, saturated at 255.
+     */
+    uint8_t getDropped();
+
+  protected:
+    Nanoshield_RTC& rtc;
+
+    uint32_t baseTime;
+    uint32_t baseMicros;
+    uint32_t lastPoll;
+    int8_t lastSecond;
+    bool synced;
+
+    // head is only written by push() and tail only by drain()
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile uint8_t dropped;
+    volatile uint8_t ids[RTC_EVENT_QUEUE_SIZE];
+    volatile uint32_t stamps[RTC_EVENT_QUEUE_SIZE];
+};
+
+#endif
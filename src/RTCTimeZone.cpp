@@ -0,0 +1,36 @@
+/**
+ * @file RTCTimeZone.cpp
+ * Time zone and daylight saving time conversion for the RTC Nanoshield
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#include "RTCTimeZone.h"
+
+RTCTimeZone::RTCTimeZone(const RTCTransition* transitions, uint8_t count, int16_t offset)
+  : transitions(transitions), count(count), offset(offset) {
+}
+
+int16_t RTCTimeZone::getOffset(uint32_t utc) const
+{
+  uint8_t lo = 0;
+  uint8_t hi = count;
+
+  // Find the number of transitions at or before utc
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (transitions[mid].time <= utc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo ? transitions[lo - 1].offset : offset;
+}
+
+uint32_t RTCTimeZone::toLocal(uint32_t utc) const
+{
+  return utc + getOffset(utc) * 60L;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file RTCTimeZone.h
+ * Time zone and daylight saving time conversion for the RTC Nanoshield
+ *
+ * Copyright (c) 2013 Circuitar
+ * This software is released under the MIT license. See the attached LICENSE file for details.
+ */
+
+#ifndef RTC_TIME_ZONE_h
+#define RTC_TIME_ZONE_h
+
+#ifdef ARDUPI
+  #include "arduPi.h"
+#else
+  #include "Arduino.h"
+#endif
+
+/**
+ * @brief A change of UTC offset.
+ */
+typedef struct {
+  uint32_t time;  ///< UTC instant of the change, in seconds since 1970-01-01 00:00:00.
+  int16_t offset; ///< UTC offset in minutes from this instant on.
+} RTCTransition;
+
+/**
+ * @brief A yearly rule for changing the UTC offset, such as "last Sunday of
+ *        March at 02:00".
+ */
+typedef struct {
+  uint8_t week;   ///< Week of the month from 1 to 4, or 5 for the last week.
+  uint8_t wday;   ///< Weekday from 0 to 6 as Sunday to Saturday respectively.
+  uint8_t month;  ///< Month from 1 to 12.
+  int16_t minute; ///< Local time of the change, in minutes after midnight.
+  int16_t offset; ///< UTC offset in minutes after the change.
+} RTCTimeRule;
+
+// Days since 1970-01-01 of a Gregorian date, with March as the first month
+constexpr uint32_t rtcDaysFromMarch(uint32_t year, uint32_t mon, uint32_t day) {
+  return year / 400 * 146097UL + year % 400 * 365UL + year % 400 / 4 - year % 400 / 100
+    + (153 * mon + 2) / 5 + day - 1 - 719468UL;
+}
+
+/**
+ * @brief Gets the number of days since 1970-01-01 of a date.
+ *
+ * @param year Year (4 digits, 1970 or later).
+ * @param mon Month from 1 to 12.
+ * @param day Day from 1 to 31.
+ * @return Days since 1970-01-01.
+ */
+constexpr uint32_t rtcDaysFromCivil(int year, int mon, int day) {
+  return rtcDaysFromMarch(year - (mon <= 2), mon > 2 ? mon - 3 : mon + 9, day);
+}
+
+// Day of the first wday on or after the given day
+constexpr uint32_t rtcWeekdayOnOrAfter(uint32_t days, uint8_t wday) {
+  return days + (wday + 7 - (days + 4) % 7) % 7;
+}
+
+// Day of the last wday on or before the given day
+constexpr uint32_t rtcWeekdayOnOrBefore(uint32_t days, uint8_t wday) {
+  return days - ((days + 4) % 7 + 7 - wday) % 7;
+}
+
+// Day on which a rule applies in the given year
+constexpr uint32_t rtcRuleDay(const RTCTimeRule& rule, int year) {
+  return rule.week >= 5
+    ? rtcWeekdayOnOrBefore(rtcDaysFromCivil(year + (rule.month == 12), rule.month % 12 + 1, 1) - 1, rule.wday)
+    : rtcWeekdayOnOrAfter(rtcDaysFromCivil(year, rule.month, 1), rule.wday) + 7 * (rule.week - 1);
+}
+
+/**
+ * @brief Gets the transition caused by a rule in a given year.
+ *
+ * @param rule The rule.
+ * @param before UTC offset in minutes before the transition.
+ * @param year Year (4 digits, 1970 or later).
+ * @return The transition.
+ */
+constexpr RTCTransition rtcTransition(const RTCTimeRule& rule, int16_t before, int year) {
+  return RTCTransition{(uint32_t)(rtcRuleDay(rule, year) * 86400UL + (rule.minute - before) * 60L), rule.offset};
+}
+
+/**
+ * @brief Expands to the two transitions of a year, in chronological order.
+ *
+ * Use it to build a transition table at compile time, for example:
+ *
+ *     constexpr RTCTimeRule cest = {5, 0, 3, 120, 120};
+ *     constexpr RTCTimeRule cet = {5, 0, 10, 180, 60};
+ *     constexpr RTCTransition berlin[] = {
+ *       RTC_TIME_ZONE_YEAR(cest, cet, 2024),
+ *       RTC_TIME_ZONE_YEAR(cest, cet, 2025)
+ *     };
+ *
+ * @param dst Rule for the start of daylight saving time.
+ * @param std Rule for the start of standard time.
+ * @param year Year (4 digits, 1970 or later).
+ */
+#define RTC_TIME_ZONE_YEAR(dst, std, year) \
+  rtcTransition((dst).month < (std).month ? (dst) : (std), \
+    (dst).month < (std).month ? (std).offset : (dst).offset, year), \
+  rtcTransition((dst).month < (std).month ? (std) : (dst), \
+    (dst).month < (std).month ? (dst).offset : (std).offset, year)
+
+/**
+ * @brief Expands to the transitions of ten consecutive years.
+ *
+ * @param dst Rule for the start of daylight saving time.
+ * @param std Rule for the start of standard time.
+ * @param year First year (4 digits, 1970 or later).
+ *
+ * @see RTC_TIME_ZONE_YEAR
+ */
+#define RTC_TIME_ZONE_DECADE(dst, std, year) \
+  RTC_TIME_ZONE_YEAR(dst, std, (year)), RTC_TIME_ZONE_YEAR(dst, std, (year) + 1), \
+  RTC_TIME_ZONE_YEAR(dst, std, (year) + 2), RTC_TIME_ZONE_YEAR(dst, std, (year) + 3), \
+  RTC_TIME_ZONE_YEAR(dst, std, (year) + 4), RTC_TIME_ZONE_YEAR(dst, std, (year) + 5), \
+  RTC_TIME_ZONE_YEAR(dst, std, (year) + 6), RTC_TIME_ZONE_YEAR(dst, std, (year) + 7), \
+  RTC_TIME_ZONE_YEAR(dst, std, (year) + 8), RTC_TIME_ZONE_YEAR(dst, std, (year) + 9)
+
+class RTCTimeZone {
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * Creates a time zone from a table of transitions.
+     *
+     * @param transitions Transitions sorted by time. The table is not copied.
+     * @param count Number of transitions in the table.
+     * @param offset UTC offset in minutes before the first transition.
+     */
+    RTCTimeZone(const RTCTransition* transitions, uint8_t count, int16_t offset);
+
+    /**
+     * @brief Gets the UTC offset at a given instant.
+     *
+     * @param utc Seconds since 1970-01-01 00:00:00 UTC.
+     * @return UTC offset in minutes.
+     */
+    int16_t getOffset(uint32_t utc) const;
+
+    /**
+     * @brief Converts UTC to local time.
+     *
+     * @param utc Seconds since 1970-01-01 00:00:00 UTC.
+     * @return Local time, in seconds since 1970-01-01 00:00:00 local time.
+     */
+    uint32_t toLocal(uint32_t utc) const;
+
+  protected:
+    const RTCTransition* transitions;
+    uint8_t count;
+    int16_t offset;
+};
+
+#endif